@@ -9,6 +9,7 @@
 #define MAX_SPELLS 4
 #define MAX_WEAPONS 5
 #define MAX_ACTIONS 100 // For turn recap
+#define MAX_STRENGTH 12 // Influence map strength buckets, higher strengths are clamped
 
 // Struct definitions
 typedef struct {
@@ -43,6 +44,26 @@ typedef struct {
     int roll, roll_needed;
 } Action;
 
+// Reachable tiles cache (one per unit)
+typedef struct {
+    int valid;
+    int x, y, movement; // Origin and movement the tiles were computed for
+    char tiles[MAP_SIZE][MAP_SIZE];
+} ReachCache;
+
+// Undo journal: field-level deltas grouped by player unit activation
+typedef struct {
+    Unit* unit; // Unit whose influence depends on the field, NULL otherwise
+    int* field;
+    int old_value, new_value;
+} Delta;
+
+typedef struct {
+    int unit_idx;
+    unsigned int rng_before, rng_after;
+    int first_delta, last_delta; // Deltas [first_delta, last_delta), first_delta < 0 until one is recorded
+} Activation;
+
 // Global variables
 char map[MAP_SIZE][MAP_SIZE];
 Unit* units = NULL; // Dynamic array for units
@@ -52,6 +73,17 @@ int current_turn = 0; // 0 for player, 1 for enemy
 int num_units = 0; // Track actual number of units
 Action actions[MAX_ACTIONS]; // Store turn actions
 int action_count = 0; // Track number of actions
+unsigned int rng_state = 1; // Dice RNG state, reseeded per engagement group
+ReachCache* reach_cache = NULL; // Parallel to units
+Delta* deltas = NULL; // Journal deltas, reset every player turn
+int delta_count = 0, delta_capacity = 0;
+Activation* activations = NULL; // Journaled activations, [0, activation_top) are applied, the rest can be redone
+int activation_count = 0, activation_capacity = 0, activation_top = 0;
+Activation current_activation;
+int journal_recording = 0; // Set while a player unit's activation is journaled
+// Expected damage each team can bring onto a tile next turn, before the wound roll,
+// bucketed by attacker strength (last bucket: damage that needs no wound roll)
+double influence[2][MAP_SIZE][MAP_SIZE][MAX_STRENGTH + 2];
 
 // Function prototypes
 void initialize_game();
@@ -59,30 +91,59 @@ void initialize_map();
 void initialize_units();
 void initialize_weapons();
 void initialize_spells();
-void display_map();
+void initialize_influence();
+void display_map(Unit* highlight);
+int random_int();
 int roll_dice(int count);
 void display_dice_roll(int roll);
 int to_hit_roll(int combat_value, int* critical, int* roll_result);
 int to_wound_roll(int attacker_strength, int defender_toughness, int* roll_result);
 int perform_attack(Unit* attacker, Unit* defender, int* hits, int is_shooting);
 int calculate_wounds(Unit* a, Unit* d, int hits);
-void movement_phase(Unit* unit);
-void magic_phase(Unit* unit);
-void shooting_phase(Unit* unit);
+int movement_phase(Unit* unit);
+int magic_phase(Unit* unit);
+int shooting_phase(Unit* unit);
 void ai_shooting_phase(Unit* unit);
 void combat_phase();
+int find_group(int* group, int i);
+int link_groups(int* group, int i, int j);
+void find_engagement_groups(int* group);
+void resolve_engagement_group(int* group, int root, int chargers);
 void apply_spell_effect(Unit* target, Spell* spell);
 int is_adjacent(Unit* unit1, Unit* unit2);
 int is_tile_occupied(int x, int y, Unit* moving_unit);
 void move_unit(Unit* unit, int new_x, int new_y);
+void damage_unit(Unit* unit, int amount);
+void update_reach(Unit* unit);
+int is_reachable(Unit* unit, int x, int y);
+void invalidate_reach(int x, int y);
+void clear_reach_cache();
 void enemy_turn();
 int is_game_over();
-Unit* find_closest_enemy(Unit* enemy);
+Unit* find_best_target(Unit* unit);
+void attack_odds(Unit* unit, double* rolled, double* certain);
+int threat_sources(Unit* unit, int x, int y);
+double wound_chance(int strength, int toughness);
+void apply_influence(Unit* unit, double sign);
+double expected_damage(int team, int x, int y, int toughness);
+double unit_damage(Unit* unit, int x, int y, int toughness);
+void choose_destination(Unit* unit, Unit* target, int* dest_x, int* dest_y);
 void turn_recap();
+void journal_set(Unit* unit, int* field, int value);
+void journal_write(Delta* delta, int value);
+void journal_reset();
+void journal_begin(int unit_idx);
+void journal_end();
+int journal_undo();
+int journal_redo();
+int journal_command(int command, int i);
+int parse_journal_command(char* input);
+int read_choice(int* value);
+int end_turn_prompt();
 
 // Main function
 int main() {
-    srand(time(NULL));
+    rng_state = (unsigned int)time(NULL);
     initialize_game();
     printf("SiteRaw RPG Game\n");
 
@@ -92,16 +153,32 @@ int main() {
 
         // Player turn
         printf("Player's turn\n");
-        for (int i = 0; i < num_units; i++) { // Player units
-            if (units[i].wounds > 0 && units[i].team == 0) {
+        journal_reset();
+        for (int i = 0; i <= num_units; i++) { // Player units, then end of turn
+            int command;
+            if (i == num_units) {
+                if (activation_top == 0) break; // No player unit acted
+                command = end_turn_prompt();
+                if (!command) break;
+            } else if (units[i].wounds > 0 && units[i].team == 0) {
                 printf("\n%s's turn:\n", units[i].name);
                 units[i].has_moved = units[i].has_run = units[i].has_charged = 0;
-                movement_phase(&units[i]);
-                if (!units[i].has_run) {
-                    magic_phase(&units[i]);
-                    shooting_phase(&units[i]);
+                journal_begin(i);
+                command = movement_phase(&units[i]);
+                if (command) {
+                    journal_recording = 0; // Nothing was recorded for this activation
+                } else {
+                    if (!units[i].has_run) {
+                        command = magic_phase(&units[i]);
+                        if (!command) command = shooting_phase(&units[i]);
+                    }
+                    journal_end(); // An undo from magic or shooting reverts this unit's own actions
+                    if (!command) continue;
                 }
+            } else {
+                continue;
             }
+            i = journal_command(command, i) - 1;
         }
         combat_phase();
 
@@ -124,6 +201,9 @@ int main() {
 	    enemy_life += units[i].wounds;
     }
     printf("\nGame Over! %s wins!\n", is_game_over() && player_life >= enemy_life ? "Player" : "Enemy");
+    free(deltas);
+    free(activations);
+    free(reach_cache);
     free(units);
     return 0;
 }
@@ -134,6 +214,7 @@ void initialize_game() {
     initialize_weapons();
     initialize_spells();
     initialize_units();
+    initialize_influence();
 }
 
 void initialize_map() {
@@ -192,7 +273,8 @@ void initialize_units() {
     rewind(file);
 
     units = (Unit*)malloc(num_units * sizeof(Unit));
-    if (!units) {
+    reach_cache = (ReachCache*)calloc(num_units, sizeof(ReachCache));
+    if (!units || !reach_cache) {
         printf("Memory allocation failed.\n");
         fclose(file);
         exit(1);
@@ -226,8 +308,14 @@ void initialize_units() {
     fclose(file);
 }
 
-// Display the game map
-void display_map() {
+void initialize_influence() {
+    memset(influence, 0, sizeof(influence));
+    for (int i = 0; i < num_units; i++)
+        apply_influence(&units[i], 1);
+}
+
+// Display the game map, marking tiles reachable by highlight (if any) with '+'
+void display_map(Unit* highlight) {
     printf("  ");
     for (int j = 0; j < MAP_SIZE; j++) printf("%c ", 'A' + j);
     printf("\n");
@@ -240,6 +328,8 @@ void display_map() {
                     unit_here = k;
             if (unit_here >= 0)
                 printf("%c ", units[unit_here].name[0]);
+            else if (highlight && is_reachable(highlight, i, j))
+                printf("+ ");
             else
                 printf(". ");
         }
@@ -248,10 +338,15 @@ void display_map() {
 }
 
 // Dice rolling
+int random_int() {
+    rng_state = rng_state * 1103515245u + 12345u; // LCG, state is saved/restored per group
+    return (rng_state >> 16) & 0x7fff;
+}
+
 int roll_dice(int count) {
     int sum = 0;
     for (int i = 0; i < count; i++) {
-        int roll = (rand() % 6) + 1;
+        int roll = (random_int() % 6) + 1;
         sum += roll;
         display_dice_roll(roll);
     }
@@ -296,7 +391,7 @@ int perform_attack(Unit* attacker, Unit* defender, int* hits, int is_shooting) {
         int hit = to_hit_roll(attacker->combat_value, &critical, &hit_rolls[i]);
         if (hit) {
             if (strcmp(attacker->weapon->special_rule, "death_wound") == 0 && critical) {
-                defender->wounds -= (1 + attacker->weapon->bonus_dmg);
+                damage_unit(defender, 1 + attacker->weapon->bonus_dmg);
                 printf("Death wound! %s loses 1 wound.\n", defender->name);
                 continue;
             }
@@ -306,7 +401,9 @@ int perform_attack(Unit* attacker, Unit* defender, int* hits, int is_shooting) {
                 if (to_wound_roll(attacker->strength + attacker->weapon->bonus_strength, defender->toughness, &wound_rolls[*hits])) {
                     (*hits)++;
                     if (critical && strcmp(attacker->weapon->special_rule, "lifesteal") == 0) {
-                        attacker->wounds += 1;
+                        apply_influence(attacker, -1);
+                        journal_set(attacker, &attacker->wounds, attacker->wounds + 1);
+                        apply_influence(attacker, 1);
                         printf("%s heals 1 wound via lifesteal!\n", attacker->name);
                     }
                 }
@@ -323,7 +420,7 @@ int perform_attack(Unit* attacker, Unit* defender, int* hits, int is_shooting) {
             actions[action_count].hits = *hits;
             actions[action_count].wounds = calculate_wounds(attacker, defender, *hits);
             actions[action_count].target_wounds = defender->wounds - actions[action_count].wounds;
-            action_count++;
+            journal_set(NULL, &action_count, action_count + 1);
         }
     //}
 
@@ -334,25 +431,27 @@ int calculate_wounds(Unit* a, Unit* d, int hits) {
     return (1 + a->weapon->bonus_dmg) * hits;
 }
 
-// Movement phase
-void movement_phase(Unit* unit) {
-    display_map();
+// Movement phase, returns 'U' or 'R' if the player asked to undo or redo instead of moving
+int movement_phase(Unit* unit) {
+    display_map(unit);
     printf("Movement phase for %s (W: %d, Movement: %d) at %c%d\n", unit->name, unit->wounds, unit->movement, 'A' + unit->y, unit->x + 1);
-    printf("Enter target position (e.g., A1) or 'S' to stay: ");
-    char input[10];
-    scanf("%s", input);
+    printf("Enter target position (e.g., A1), 'S' to stay, 'U' to undo or 'R' to redo: ");
+    char input[10] = "";
+    scanf("%9s", input);
+
+    int command = parse_journal_command(input);
+    if (command) return command;
 
     if (input[0] == 'S' || input[0] == 's') {
-        unit->has_moved = 1;
-        return;
+        journal_set(NULL, &unit->has_moved, 1);
+        return 0;
     }
 
     int new_y = toupper(input[0]) - 'A';
     int new_x = atoi(&input[1]) - 1;
 
     if (new_x >= 0 && new_x < MAP_SIZE && new_y >= 0 && new_y < MAP_SIZE) {
-        int distance = abs(new_x - unit->x) + abs(new_y - unit->y);
-        if (distance <= unit->movement && !is_tile_occupied(new_x, new_y, unit)) {
+        if (is_reachable(unit, new_x, new_y)) {
             // Check if unit is adjacent to any enemy before moving
             int was_adjacent = 0;
             for (int i = 0; i < num_units; i++) {
@@ -364,7 +463,7 @@ void movement_phase(Unit* unit) {
 
             // Move unit
             move_unit(unit, new_x, new_y);
-            unit->has_moved = 1;
+            journal_set(NULL, &unit->has_moved, 1);
 
             // Check if unit is adjacent to any enemy after moving
             int is_adjacent_now = 0;
@@ -377,28 +476,29 @@ void movement_phase(Unit* unit) {
 
             // Set has_charged if unit wasn't adjacent before but is now
             if (!was_adjacent && is_adjacent_now) {
-                unit->has_charged = 1;
+                journal_set(NULL, &unit->has_charged, 1);
                 printf("%s has charged into combat!\n", unit->name);
             }
         } else {
-            printf("Invalid move: %s\n", distance > unit->movement ? "Too far!" : "Tile occupied!");
+            printf("Invalid move: %s\n", is_tile_occupied(new_x, new_y, unit) ? "Tile occupied!" : "Out of reach!");
         }
     } else {
         printf("Invalid position!\n");
     }
-    display_map();
+    display_map(NULL);
+    return 0;
 }
 
-// Magic phase
-void magic_phase(Unit* unit) {
-    if (!unit->is_magic) return;
+// Magic phase, returns 'U' if the player asked to undo this unit's actions
+int magic_phase(Unit* unit) {
+    if (!unit->is_magic) return 0;
     printf("Magic phase for %s\n", unit->name);
     for (int i = 0; i < MAX_SPELLS; i++)
         printf("%d: %s (Cost: %d, Target: %s)\n", i + 1, spells[i].name, spells[i].cost, spells[i].target);
-    printf("0: Skip\n");
+    printf("0: Skip\nU: Undo\n");
     int choice;
-    scanf("%d", &choice);
-    if (choice == 0 || choice > MAX_SPELLS) return;
+    if (read_choice(&choice)) return 'U';
+    if (choice <= 0 || choice > MAX_SPELLS) return 0;
 
     Spell* spell = &spells[choice - 1];
     printf("Select target:\n");
@@ -411,19 +511,20 @@ void magic_phase(Unit* unit) {
     }
     if (valid_targets == 0) {
         printf("No valid targets!\n");
-        return;
+        return 0;
     }
+    printf("U: Undo\n");
 
     int target_idx;
-    scanf("%d", &target_idx);
+    if (read_choice(&target_idx)) return 'U';
     if (target_idx < 0 || target_idx >= num_units || units[target_idx].wounds <= 0) {
         printf("Invalid target!\n");
-        return;
+        return 0;
     }
     if ((strcmp(spell->target, "ally") == 0 && units[target_idx].team != unit->team) ||
         (strcmp(spell->target, "enemy") == 0 && units[target_idx].team == unit->team)) {
         printf("Invalid target team!\n");
-        return;
+        return 0;
     }
 
     int roll = roll_dice(2);
@@ -441,13 +542,14 @@ void magic_phase(Unit* unit) {
             actions[action_count].action_type = (roll >= spell->cost) ? 1 : 3; // Magic
             actions[action_count].roll = roll;
             actions[action_count].roll_needed = spell->cost;
-            action_count++;
+            journal_set(NULL, &action_count, action_count + 1);
         }
+    return 0;
 }
 
-// Shooting phase
-void shooting_phase(Unit* unit) {
-    if (unit->weapon->range <= 1) return;
+// Shooting phase, returns 'U' if the player asked to undo this unit's actions
+int shooting_phase(Unit* unit) {
+    if (unit->weapon->range <= 1) return 0;
     printf("Shooting phase for %s\n", unit->name);
     printf("Select target:\n");
     int valid_targets = 0;
@@ -459,83 +561,120 @@ void shooting_phase(Unit* unit) {
     }
     if (valid_targets == 0) {
         printf("No valid targets!\n");
-        return;
+        return 0;
     }
+    printf("U: Undo\n");
 
     int target_idx;
-    scanf("%d", &target_idx);
+    if (read_choice(&target_idx)) return 'U';
     if (target_idx < 0 || target_idx >= num_units || units[target_idx].wounds <= 0 || units[target_idx].team == unit->team) {
         printf("Invalid target!\n");
-        return;
+        return 0;
     }
 
     int hits;
     perform_attack(unit, &units[target_idx], &hits, 1); // is_shooting = 1
     int wounds = calculate_wounds(unit, &units[target_idx], hits);
-    units[target_idx].wounds -= wounds;
+    damage_unit(&units[target_idx], wounds);
     printf("%s shoots %s, deals %d wounds\n", unit->name, units[target_idx].name, wounds);
+    return 0;
 }
 
 // AI shooting phase
 void ai_shooting_phase(Unit* unit) {
     if (unit->weapon->range <= 1 || unit->has_run) return;
 
-    Unit* target = find_closest_enemy(unit);
+    Unit* target = find_best_target(unit);
     if (!target) return;
 
     int hits;
     perform_attack(unit, target, &hits, 1); // is_shooting = 1
     int wounds = calculate_wounds(unit, target, hits);
-    target->wounds -= wounds;
+    damage_unit(target, wounds);
     printf("%s shoots %s, deals %d wounds\n", unit->name, target->name, wounds);
 }
 
 // Combat phase
 void combat_phase() {
-    // First pass: process charging units
-    for (int i = 0; i < num_units; i++) {
-        if (units[i].wounds <= 0 || !units[i].has_charged) continue;
-        for (int j = 0; j < num_units; j++) {
-            if (units[j].wounds <= 0 || units[j].team == units[i].team) continue;
-            if (is_adjacent(&units[i], &units[j])) {
-                printf("Combat between %s (charger) and %s\n", units[i].name, units[j].name);
-                int attacker_hits, defender_hits;
+    int group[num_units];
+    find_engagement_groups(group);
+
+    // Each engagement group rolls from its own stream, so the outcome doesn't depend on group order
+    random_int();
+    unsigned int base_state = rng_state;
+    for (int g = 0; g < num_units; g++) {
+        if (group[g] != g) continue; // Groups are keyed by their lowest unit index
+        rng_state = base_state + 0x9E3779B9u * (g + 1);
+        resolve_engagement_group(group, g, 1); // First pass: charging units
+        resolve_engagement_group(group, g, 0); // Second pass: non-charging units
+    }
+    rng_state = base_state;
+}
 
-                // Attacker (charger) goes first
-                perform_attack(&units[i], &units[j], &attacker_hits, 0); // is_shooting = 0
+// Find the group root of unit i (path halving)
+int find_group(int* group, int i) {
+    while (group[i] != i) {
+        group[i] = group[group[i]];
+        i = group[i];
+    }
+    return i;
+}
 
-                // Defender retaliates if alive
-                if (units[j].wounds > 0) {
-                    perform_attack(&units[j], &units[i], &defender_hits, 0); // is_shooting = 0
-                } else {
-                    defender_hits = 0;
-                }
+// Merge the groups of units i and j, keeping the lowest index as root; returns 1 if they were apart
+int link_groups(int* group, int i, int j) {
+    int ri = find_group(group, i), rj = find_group(group, j);
+    if (ri == rj) return 0;
+    if (ri < rj) group[rj] = ri;
+    else group[ri] = rj;
+    return 1;
+}
 
-                // Resolve combat
-                int attacker_dmg = calculate_wounds(&units[i], &units[j], attacker_hits);
-                int defender_dmg = calculate_wounds(&units[j], &units[i], defender_hits);
-                units[j].wounds -= attacker_dmg;
-                units[i].wounds -= defender_dmg;
-                printf("%s deals %d damage (%d), %s deals %d damage (%d)\n", units[i].name, attacker_dmg, units[j].wounds, units[j].name, defender_dmg, units[i].wounds);
+// Split units into engagement groups that share no state during combat_phase.
+// Groups start as connected components of adjacent living enemies. A unit retreats one
+// tile per fight it starts, so at most once per enemy in its group; groups whose units
+// could end up sharing, freeing or touching a tile within those retreats are merged
+// until stable. No fight, retreat or blocked tile then crosses a group boundary.
+void find_engagement_groups(int* group) {
+    int retreats[num_units];
+    for (int i = 0; i < num_units; i++) group[i] = i;
+    for (int i = 0; i < num_units; i++) {
+        if (units[i].wounds <= 0) continue;
+        for (int j = i + 1; j < num_units; j++)
+            if (units[j].wounds > 0 && units[j].team != units[i].team && is_adjacent(&units[i], &units[j]))
+                link_groups(group, i, j);
+    }
 
-                // Move charger back if defender survives
-                if (units[j].wounds > 0) {
-                    int dx = units[i].x > units[j].x ? 1 : (units[i].x < units[j].x ? -1 : 0);
-                    int dy = units[i].y > units[j].y ? 1 : (units[i].y < units[j].y ? -1 : 0);
-                    if (!is_tile_occupied(units[i].x + dx, units[i].y + dy, &units[i]))
-                        move_unit(&units[i], units[i].x + dx, units[i].y + dy);
-                }
+    int merged = 1;
+    while (merged) {
+        merged = 0;
+        for (int i = 0; i < num_units; i++) {
+            retreats[i] = 0;
+            if (units[i].wounds <= 0) continue;
+            for (int j = 0; j < num_units; j++)
+                if (units[j].wounds > 0 && units[j].team != units[i].team && find_group(group, i) == find_group(group, j))
+                    retreats[i]++;
+        }
+        for (int i = 0; i < num_units; i++) {
+            if (units[i].wounds <= 0) continue;
+            for (int j = i + 1; j < num_units; j++) {
+                if (units[j].wounds <= 0 || retreats[i] + retreats[j] == 0) continue;
+                int distance = abs(units[i].x - units[j].x) + abs(units[i].y - units[j].y);
+                if (distance <= retreats[i] + retreats[j] + 1 && link_groups(group, i, j))
+                    merged = 1;
             }
         }
     }
+    for (int i = 0; i < num_units; i++) group[i] = find_group(group, i);
+}
 
-    // Second pass: process non-charging units
+// Resolve combat within one engagement group, either for charging or non-charging units
+void resolve_engagement_group(int* group, int root, int chargers) {
     for (int i = 0; i < num_units; i++) {
-        if (units[i].wounds <= 0 || units[i].has_charged) continue;
+        if (group[i] != root || units[i].wounds <= 0 || units[i].has_charged != chargers) continue;
         for (int j = 0; j < num_units; j++) {
-            if (units[j].wounds <= 0 || units[j].team == units[i].team) continue;
+            if (group[j] != root || units[j].wounds <= 0 || units[j].team == units[i].team) continue;
             if (is_adjacent(&units[i], &units[j])) {
-                printf("Combat between %s and %s\n", units[i].name, units[j].name);
+                printf("Combat between %s%s and %s\n", units[i].name, chargers ? " (charger)" : "", units[j].name);
                 int attacker_hits, defender_hits;
 
                 // Attacker goes first
@@ -551,8 +690,8 @@ void combat_phase() {
                 // Resolve combat
                 int attacker_dmg = calculate_wounds(&units[i], &units[j], attacker_hits);
                 int defender_dmg = calculate_wounds(&units[j], &units[i], defender_hits);
-                units[j].wounds -= attacker_dmg;
-                units[i].wounds -= defender_dmg;
+                damage_unit(&units[j], attacker_dmg);
+                damage_unit(&units[i], defender_dmg);
                 printf("%s deals %d damage (%d), %s deals %d damage (%d)\n", units[i].name, attacker_dmg, units[j].wounds, units[j].name, defender_dmg, units[i].wounds);
 
                 // Move attacker back if defender survives
@@ -571,14 +710,19 @@ void combat_phase() {
 void apply_spell_effect(Unit* target, Spell* spell) {
     printf("%s cast on %s\n", spell->name, target->name);
     if (strcmp(spell->effect, "+1 toughness") == 0)
-        target->toughness += 1;
-    else if (strcmp(spell->effect, "-1 to hit") == 0)
-        target->combat_value = (target->combat_value > 1 && target->combat_value < 6) ? target->combat_value - 1 : target->combat_value;
-    else if (strcmp(spell->effect, "+1 strength") == 0)
-        target->strength += 1;
+        journal_set(NULL, &target->toughness, target->toughness + 1);
+    else if (strcmp(spell->effect, "-1 to hit") == 0) {
+        apply_influence(target, -1);
+        journal_set(target, &target->combat_value, (target->combat_value > 1 && target->combat_value < 6) ? target->combat_value - 1 : target->combat_value);
+        apply_influence(target, 1);
+    } else if (strcmp(spell->effect, "+1 strength") == 0) {
+        apply_influence(target, -1);
+        journal_set(target, &target->strength, target->strength + 1);
+        apply_influence(target, 1);
+    }
     else if (strcmp(spell->effect, "1D6 hits + move") == 0) {
         int hits = roll_dice(1);
-        target->wounds -= hits;
+        damage_unit(target, hits);
         int dir = roll_dice(1);
         int dx = 0, dy = 0;
         if (dir <= 3) dx = -3; // back
@@ -608,27 +752,206 @@ int is_tile_occupied(int x, int y, Unit* moving_unit) {
 // Move unit on map
 void move_unit(Unit* unit, int new_x, int new_y) {
     if (new_x >= 0 && new_x < MAP_SIZE && new_y >= 0 && new_y < MAP_SIZE && !is_tile_occupied(new_x, new_y, unit)) {
-        unit->x = new_x;
-        unit->y = new_y;
+        invalidate_reach(unit->x, unit->y);
+        invalidate_reach(new_x, new_y);
+        apply_influence(unit, -1);
+        journal_set(unit, &unit->x, new_x);
+        journal_set(unit, &unit->y, new_y);
+        apply_influence(unit, 1);
     }
 }
 
-// Find closest enemy unit
-Unit* find_closest_enemy(Unit* enemy) {
+// Apply wounds to a unit, freeing its tile if it dies
+void damage_unit(Unit* unit, int amount) {
+    int was_alive = unit->wounds > 0;
+    apply_influence(unit, -1);
+    journal_set(unit, &unit->wounds, unit->wounds - amount);
+    apply_influence(unit, 1);
+    if (was_alive && unit->wounds <= 0)
+        invalidate_reach(unit->x, unit->y);
+}
+
+// Compute the tiles a unit can reach with a bounded BFS around blocking units
+void update_reach(Unit* unit) {
+    ReachCache* cache = &reach_cache[unit - units];
+    if (cache->valid && cache->x == unit->x && cache->y == unit->y && cache->movement == unit->movement)
+        return;
+
+    int dist[MAP_SIZE][MAP_SIZE];
+    int queue[MAP_SIZE * MAP_SIZE];
+    int head = 0, tail = 0;
+    for (int i = 0; i < MAP_SIZE; i++)
+        for (int j = 0; j < MAP_SIZE; j++) {
+            dist[i][j] = -1;
+            cache->tiles[i][j] = 0;
+        }
+
+    dist[unit->x][unit->y] = 0;
+    cache->tiles[unit->x][unit->y] = 1;
+    queue[tail++] = unit->x * MAP_SIZE + unit->y;
+    while (head < tail) {
+        int x = queue[head] / MAP_SIZE, y = queue[head] % MAP_SIZE;
+        head++;
+        if (dist[x][y] >= unit->movement) continue;
+        int dirs[4][2] = {{1, 0}, {-1, 0}, {0, 1}, {0, -1}};
+        for (int d = 0; d < 4; d++) {
+            int nx = x + dirs[d][0], ny = y + dirs[d][1];
+            if (nx < 0 || nx >= MAP_SIZE || ny < 0 || ny >= MAP_SIZE || dist[nx][ny] >= 0) continue;
+            if (is_tile_occupied(nx, ny, unit)) continue;
+            dist[nx][ny] = dist[x][y] + 1;
+            cache->tiles[nx][ny] = 1;
+            queue[tail++] = nx * MAP_SIZE + ny;
+        }
+    }
+
+    cache->x = unit->x;
+    cache->y = unit->y;
+    cache->movement = unit->movement;
+    cache->valid = 1;
+}
+
+// Check if a unit can move to a tile this turn
+int is_reachable(Unit* unit, int x, int y) {
+    if (x < 0 || x >= MAP_SIZE || y < 0 || y >= MAP_SIZE) return 0;
+    update_reach(unit);
+    return reach_cache[unit - units].tiles[x][y];
+}
+
+// Drop cached reach of units whose search area covers a tile that changed
+void invalidate_reach(int x, int y) {
+    for (int i = 0; i < num_units; i++) {
+        ReachCache* cache = &reach_cache[i];
+        if (cache->valid && abs(cache->x - x) + abs(cache->y - y) <= cache->movement + 1)
+            cache->valid = 0;
+    }
+}
+
+// Drop every cached reach, used when the journal rewrites positions and wounds
+void clear_reach_cache() {
+    for (int i = 0; i < num_units; i++)
+        reach_cache[i].valid = 0;
+}
+
+// Pick a target: the enemy this unit can hurt most next turn, weighted by how close its team
+// is to finishing it off. Falls back to the closest enemy when none is within the unit's reach.
+Unit* find_best_target(Unit* unit) {
     Unit* target = NULL;
+    double best_score = -1;
     int min_distance = MAP_SIZE * 2;
     for (int i = 0; i < num_units; i++) {
-        if (units[i].wounds > 0 && units[i].team != enemy->team) {
-            int distance = abs(enemy->x - units[i].x) + abs(enemy->y - units[i].y);
-            if (distance < min_distance) {
-                min_distance = distance;
-                target = &units[i];
-            }
+        if (units[i].wounds <= 0 || units[i].team == unit->team) continue;
+        double own = unit_damage(unit, units[i].x, units[i].y, units[i].toughness);
+        double score = own * expected_damage(unit->team, units[i].x, units[i].y, units[i].toughness) / units[i].wounds;
+        int distance = abs(unit->x - units[i].x) + abs(unit->y - units[i].y);
+        if (score > best_score + 1e-9 || (score > best_score - 1e-9 && distance < min_distance)) {
+            best_score = score;
+            min_distance = distance;
+            target = &units[i];
         }
     }
     return target;
 }
 
+// Expected damage per turn of a unit's weapon, split into damage that goes through a wound
+// roll and damage that needs none
+void attack_odds(Unit* unit, double* rolled, double* certain) {
+    Weapon* weapon = unit->weapon;
+    // A roll >= 7 - combat_value hits (no automatic hit on a 6), and special rules
+    // trigger on a 6 only when it hits
+    double hit = unit->combat_value / 6.0;
+    if (hit > 1) hit = 1;
+    if (hit < 0) hit = 0;
+    *rolled = hit;
+    *certain = 0;
+    if (hit > 0 && strcmp(weapon->special_rule, "critical_hit") == 0)
+        *rolled += 1 / 6.0;
+    else if (hit > 0 && strcmp(weapon->special_rule, "death_wound") == 0) {
+        *rolled -= 1 / 6.0;
+        *certain = 1 / 6.0;
+    }
+    double damage = weapon->attacks * (1 + weapon->bonus_dmg);
+    *rolled *= damage;
+    *certain *= damage;
+}
+
+// Number of ways a unit can attack a tile next turn: melee after moving, plus shooting for ranged weapons
+int threat_sources(Unit* unit, int x, int y) {
+    int distance = abs(x - unit->x) + abs(y - unit->y);
+    return (distance <= unit->movement + 1) + (unit->weapon->range > 1 && distance <= unit->movement + unit->weapon->range);
+}
+
+// Chance to wound, as in to_wound_roll
+double wound_chance(int strength, int toughness) {
+    int needed = 4 - strength + toughness;
+    if (needed < 2) needed = 2;
+    if (needed > 6) needed = 6;
+    return (7 - needed) / 6.0;
+}
+
+// Add (sign = 1) or remove (sign = -1) a unit's expected damage over the tiles it can threaten
+void apply_influence(Unit* unit, double sign) {
+    if (unit->wounds <= 0) return;
+    int strength = unit->strength + unit->weapon->bonus_strength;
+    if (strength < 0) strength = 0;
+    if (strength > MAX_STRENGTH) strength = MAX_STRENGTH;
+    double rolled, certain;
+    attack_odds(unit, &rolled, &certain);
+
+    int reach = unit->movement + (unit->weapon->range > 1 ? unit->weapon->range : 1);
+    for (int x = unit->x - reach; x <= unit->x + reach; x++) {
+        if (x < 0 || x >= MAP_SIZE) continue;
+        for (int y = unit->y - reach; y <= unit->y + reach; y++) {
+            if (y < 0 || y >= MAP_SIZE) continue;
+            int sources = threat_sources(unit, x, y);
+            if (!sources) continue;
+            influence[unit->team][x][y][strength] += sign * sources * rolled;
+            influence[unit->team][x][y][MAX_STRENGTH + 1] += sign * sources * certain;
+        }
+    }
+}
+
+// Expected wounds a team can deal next turn to a unit of given toughness standing on a tile
+double expected_damage(int team, int x, int y, int toughness) {
+    double* buckets = influence[team][x][y];
+    double total = buckets[MAX_STRENGTH + 1];
+    for (int s = 0; s <= MAX_STRENGTH; s++)
+        if (buckets[s] != 0)
+            total += buckets[s] * wound_chance(s, toughness);
+    return total;
+}
+
+// Expected wounds a single unit can deal next turn to a unit of given toughness standing on a tile
+double unit_damage(Unit* unit, int x, int y, int toughness) {
+    int sources = threat_sources(unit, x, y);
+    if (unit->wounds <= 0 || !sources) return 0;
+    double rolled, certain;
+    attack_odds(unit, &rolled, &certain);
+    return sources * (rolled * wound_chance(unit->strength + unit->weapon->bonus_strength, toughness) + certain);
+}
+
+// Pick the reachable tile closest to the target (within range for shooters), least threatened on ties
+void choose_destination(Unit* unit, Unit* target, int* dest_x, int* dest_y) {
+    int range = unit->weapon->range > 1 ? unit->weapon->range : 1;
+    int best_gap = MAP_SIZE * 2;
+    double best_danger = 0;
+    *dest_x = unit->x;
+    *dest_y = unit->y;
+    for (int x = 0; x < MAP_SIZE; x++) {
+        for (int y = 0; y < MAP_SIZE; y++) {
+            if (!is_reachable(unit, x, y)) continue;
+            int gap = abs(x - target->x) + abs(y - target->y) - range;
+            if (gap < 0) gap = 0;
+            double danger = expected_damage(!unit->team, x, y, unit->toughness);
+            if (gap < best_gap || (gap == best_gap && danger < best_danger - 1e-9)) {
+                best_gap = gap;
+                best_danger = danger;
+                *dest_x = x;
+                *dest_y = y;
+            }
+        }
+    }
+}
+
 // Simple AI for enemy turn
 void enemy_turn() {
     for (int i = 0; i < num_units; i++) {
@@ -636,8 +959,8 @@ void enemy_turn() {
         if (enemy->wounds <= 0 || enemy->team != 1) continue;
         enemy->has_moved = enemy->has_run = enemy->has_charged = 0;
 
-        // Move towards nearest player unit
-        Unit* target = find_closest_enemy(enemy);
+        // Move towards the best scored player unit
+        Unit* target = find_best_target(enemy);
         if (!target) continue;
 
         // Check if adjacent to any enemy before moving
@@ -649,55 +972,9 @@ void enemy_turn() {
             }
         }
 
-        // Calculate direction and distance
-        int dx = target->x - enemy->x;
-        int dy = target->y - enemy->y;
-        int new_x = enemy->x, new_y = enemy->y;
-        int moves_left = enemy->movement;
-
-        // Move as close as possible while respecting movement limit and collision
-        while (moves_left > 0 && (dx != 0 || dy != 0)) {
-            int step_x = 0, step_y = 0;
-            if (abs(dx) > abs(dy)) {
-                step_x = dx > 0 ? 1 : -1;
-            } else if (dy != 0) {
-                step_y = dy > 0 ? 1 : -1;
-            } else {
-                step_x = dx > 0 ? 1 : -1;
-            }
-
-            int next_x = new_x + step_x;
-            int next_y = new_y + step_y;
-            if (!is_tile_occupied(next_x, next_y, enemy)) {
-                new_x = next_x;
-                new_y = next_y;
-                dx -= step_x;
-                dy -= step_y;
-                moves_left--;
-            } else {
-                // Try alternative direction if blocked
-                if (step_x != 0) {
-                    step_x = 0;
-                    step_y = dy > 0 ? 1 : (dy < 0 ? -1 : 0);
-                } else {
-                    step_y = 0;
-                    step_x = dx > 0 ? 1 : (dx < 0 ? -1 : 0);
-                }
-                next_x = new_x + step_x;
-                next_y = new_y + step_y;
-                if (!is_tile_occupied(next_x, next_y, enemy)) {
-                    new_x = next_x;
-                    new_y = next_y;
-                    dx -= step_x;
-                    dy -= step_y;
-                    moves_left--;
-                } else {
-                    break; // No valid move available
-                }
-            }
-        }
-
         // Move unit
+        int new_x, new_y;
+        choose_destination(enemy, target, &new_x, &new_y);
         move_unit(enemy, new_x, new_y);
         enemy->has_moved = 1;
 
@@ -716,7 +993,7 @@ void enemy_turn() {
             printf("%s has charged into combat!\n", enemy->name);
         }
 
-        display_map();
+        display_map(NULL);
 
         // Shooting phase
         ai_shooting_phase(enemy);
@@ -762,3 +1039,134 @@ void turn_recap() {
         }
     }
 }
+
+// Write a game field, recording the delta while a player activation is journaled.
+// unit is the unit whose influence depends on the field (NULL otherwise); callers keep
+// the influence map up to date themselves, undo and redo use it to do the same.
+void journal_set(Unit* unit, int* field, int value) {
+    if (journal_recording && *field != value) {
+        if (current_activation.first_delta < 0) {
+            // First change of this activation: anything left to redo is discarded
+            activation_count = activation_top;
+            delta_count = activation_top > 0 ? activations[activation_top - 1].last_delta : 0;
+            current_activation.first_delta = delta_count;
+        }
+        if (delta_count == delta_capacity) {
+            delta_capacity = delta_capacity ? delta_capacity * 2 : 64;
+            deltas = (Delta*)realloc(deltas, delta_capacity * sizeof(Delta));
+            if (!deltas) {
+                printf("Memory allocation failed.\n");
+                exit(1);
+            }
+        }
+        deltas[delta_count].unit = unit;
+        deltas[delta_count].field = field;
+        deltas[delta_count].old_value = *field;
+        deltas[delta_count].new_value = value;
+        delta_count++;
+    }
+    *field = value;
+}
+
+// Replay a journaled write, moving the unit's influence along with it
+void journal_write(Delta* delta, int value) {
+    if (delta->unit) apply_influence(delta->unit, -1);
+    *delta->field = value;
+    if (delta->unit) apply_influence(delta->unit, 1);
+}
+
+// Start a new player turn with an empty journal
+void journal_reset() {
+    delta_count = activation_count = activation_top = 0;
+    journal_recording = 0;
+}
+
+// Start journaling a player unit's activation
+void journal_begin(int unit_idx) {
+    current_activation.unit_idx = unit_idx;
+    current_activation.rng_before = rng_state;
+    current_activation.first_delta = -1;
+    journal_recording = 1;
+}
+
+// Close the current activation and push it on the undo stack
+void journal_end() {
+    journal_recording = 0;
+    if (current_activation.first_delta < 0) {
+        // Nothing changed, still discard what was left to redo
+        activation_count = activation_top;
+        delta_count = activation_top > 0 ? activations[activation_top - 1].last_delta : 0;
+        current_activation.first_delta = delta_count;
+    }
+    current_activation.last_delta = delta_count;
+    current_activation.rng_after = rng_state;
+    if (activation_count == activation_capacity) {
+        activation_capacity = activation_capacity ? activation_capacity * 2 : 16;
+        activations = (Activation*)realloc(activations, activation_capacity * sizeof(Activation));
+        if (!activations) {
+            printf("Memory allocation failed.\n");
+            exit(1);
+        }
+    }
+    activations[activation_count++] = current_activation;
+    activation_top = activation_count;
+}
+
+// Revert the last applied activation, returns its unit index or -1
+int journal_undo() {
+    if (activation_top == 0) return -1;
+    Activation* a = &activations[--activation_top];
+    for (int d = a->last_delta - 1; d >= a->first_delta; d--)
+        journal_write(&deltas[d], deltas[d].old_value);
+    rng_state = a->rng_before;
+    clear_reach_cache();
+    return a->unit_idx;
+}
+
+// Re-apply the last undone activation, returns its unit index or -1
+int journal_redo() {
+    if (activation_top == activation_count) return -1;
+    Activation* a = &activations[activation_top++];
+    for (int d = a->first_delta; d < a->last_delta; d++)
+        journal_write(&deltas[d], deltas[d].new_value);
+    rng_state = a->rng_after;
+    clear_reach_cache();
+    return a->unit_idx;
+}
+
+// Run an undo/redo command issued at unit i, returns the unit index to resume at
+int journal_command(int command, int i) {
+    int unit_idx = command == 'U' ? journal_undo() : journal_redo();
+    if (unit_idx < 0) {
+        printf("Nothing to %s!\n", command == 'U' ? "undo" : "redo");
+        return i;
+    }
+    printf("%s %s's actions.\n", command == 'U' ? "Undid" : "Redid", units[unit_idx].name);
+    return command == 'U' ? unit_idx : unit_idx + 1;
+}
+
+// Recognize a lone 'U' (undo) or 'R' (redo), returns 0 for anything else
+int parse_journal_command(char* input) {
+    if (input[0] == '\0' || input[1] != '\0') return 0;
+    char c = toupper(input[0]);
+    return (c == 'U' || c == 'R') ? c : 0;
+}
+
+// Read a numeric choice (-1 if not a number), returns 'U' instead if the player asked to undo
+int read_choice(int* value) {
+    char input[10] = "";
+    scanf("%9s", input);
+    if (parse_journal_command(input) == 'U') return 'U';
+    char* end;
+    long number = strtol(input, &end, 10);
+    *value = (end == input || *end != '\0') ? -1 : (int)number;
+    return 0;
+}
+
+// Ask whether to end the player turn, returns 'U' or 'R' to keep going
+int end_turn_prompt() {
+    printf("\nEnter 'U' to undo, 'R' to redo or anything else to end the turn: ");
+    char input[10] = "";
+    scanf("%9s", input);
+    return parse_journal_command(input);
+}